@@ -1,11 +1,18 @@
 #include "CompilerParser.h"
+#include "Trace.h"
 
 /**
  * Constructor for the CompilerParser
  * @param tokens A linked list of tokens to be parsed
+ * @param maxDepth How deeply the parser may recurse on the call stack before a ParseException is thrown.
+ *                 Statements and expressions are parsed on an explicit stack and do not count towards it;
+ *                 each subroutine declared inside a term does.
  */
-CompilerParser::CompilerParser(std::list<Token*> tokens) {
+CompilerParser::CompilerParser(std::list<Token*> tokens, int maxDepth) {
     this->tokens = tokens;
+    this->depth = 0;
+    this->maxDepth = maxDepth;
+    this->scratch = NULL;
 }
 
 /**
@@ -14,13 +21,13 @@ CompilerParser::CompilerParser(std::list<Token*> tokens) {
  */
 ParseTree* CompilerParser::compileProgram() {
     // create passtree
-    ParseTree* tree = new ParseTree("class", "");
+    ParseTree* tree = newTree("class");
 
     // add keyword class
     tree->addChild(mustBe("keyword", "class"));
 
     // add identifier
-    tree->addChild(mustBe("identifier", current()->getValue()));
+    tree->addChild(mustBe("identifier", currentValue()));
 
     // add open bracket
     tree->addChild(mustBe("symbol", "{"));
@@ -36,19 +43,24 @@ ParseTree* CompilerParser::compileProgram() {
  * @return a ParseTree
  */
 ParseTree* CompilerParser::compileClass() {
+    TraceSpan span("compileClass", "parse");
+
     // create passtree
-    ParseTree* tree = new ParseTree("class", "");
+    ParseTree* tree = newTree("class");
 
     // add keyword class
     tree->addChild(mustBe("keyword", "class"));
 
     // add identifier
-    tree->addChild(mustBe("identifier", current()->getValue()));
+    tree->addChild(mustBe("identifier", currentValue()));
+    if (Trace::enabled()) {
+        span.setName("compileClass " + tree->getChildren().back()->getValue());
+    }
 
     // add open bracket
     tree->addChild(mustBe("symbol", "{"));
 
-    while (current() != NULL && have("keyword", current()->getValue())){
+    while (current() != NULL && have("keyword", currentValue())){
         // add variable decleration
         if (have("keyword", "static") || have("keyword", "field")){
             tree->addChild(compileClassVarDec());
@@ -73,13 +85,13 @@ ParseTree* CompilerParser::compileClass() {
  */
 ParseTree* CompilerParser::compileClassVarDec() {
     // create passtree
-    ParseTree* tree = new ParseTree("classVarDec", "");
+    ParseTree* tree = newTree("classVarDec");
 
     // add keyword static
     if (have("keyword", "static")){
         tree->addChild(mustBe("keyword", "static"));
     }
-    else if (current()->getValue() == "field"){
+    else if (currentValue() == "field"){
         tree->addChild(mustBe("keyword", "field"));
     }
     else{
@@ -87,14 +99,14 @@ ParseTree* CompilerParser::compileClassVarDec() {
     }
 
     // add type variable
-    tree->addChild(mustBe("keyword", current()->getValue()));
+    tree->addChild(mustBe("keyword", currentValue()));
 
     // add identifier
-    tree->addChild(mustBe("identifier", current()->getValue()));
+    tree->addChild(mustBe("identifier", currentValue()));
 
     while (current() != NULL && have("symbol", ",")){
         tree->addChild(mustBe("symbol", ","));
-        tree->addChild(mustBe("identifier", current()->getValue()));
+        tree->addChild(mustBe("identifier", currentValue()));
     }
 
     // add semi-colon
@@ -108,8 +120,10 @@ ParseTree* CompilerParser::compileClassVarDec() {
  * @return a ParseTree
  */
 ParseTree* CompilerParser::compileSubroutine() {
+    DepthGuard guard(this);
+
     // create passtree
-    ParseTree* tree = new ParseTree("subroutine", "");
+    ParseTree* tree = newTree("subroutine");
 
     // add keyword type
     if (have("keyword", "function")){
@@ -126,18 +140,18 @@ ParseTree* CompilerParser::compileSubroutine() {
     }
 
     // add keyword func type
-    if (have("keyword", current()->getValue())){
-        tree->addChild(mustBe("keyword", current()->getValue()));
+    if (have("keyword", currentValue())){
+        tree->addChild(mustBe("keyword", currentValue()));
     }
-    else if (have("identifier", current()->getValue())){
-        tree->addChild(mustBe("identifier", current()->getValue()));
+    else if (have("identifier", currentValue())){
+        tree->addChild(mustBe("identifier", currentValue()));
     }
     else{
         throw ParseException();
     }
 
     // add identifier
-    tree->addChild(mustBe("identifier", current()->getValue()));
+    tree->addChild(mustBe("identifier", currentValue()));
 
     // add open bracket
     tree->addChild(mustBe("symbol", "("));
@@ -160,36 +174,36 @@ ParseTree* CompilerParser::compileSubroutine() {
  */
 ParseTree* CompilerParser::compileParameterList() {
     // create passtree
-    ParseTree* tree = new ParseTree("parameterList", "");
+    ParseTree* tree = newTree("parameterList");
 
-    if (have("keyword", current()->getValue())){
+    if (have("keyword", currentValue())){
         // add variable type
-        tree->addChild(mustBe("keyword", current()->getValue()));
+        tree->addChild(mustBe("keyword", currentValue()));
 
         // add identifier
-        tree->addChild(mustBe("identifier", current()->getValue()));
+        tree->addChild(mustBe("identifier", currentValue()));
     }
-    else if (have("identifier", current()->getValue())){
+    else if (have("identifier", currentValue())){
         // add variable type
-        tree->addChild(mustBe("identifier", current()->getValue()));
+        tree->addChild(mustBe("identifier", currentValue()));
 
         // add identifier
-        tree->addChild(mustBe("identifier", current()->getValue()));
+        tree->addChild(mustBe("identifier", currentValue()));
     }
 
     while (current() != NULL && have("symbol", ",")){
         tree->addChild(mustBe("symbol", ","));
         
-        if (have("keyword", current()->getValue())){
+        if (have("keyword", currentValue())){
             // add variable type
-            tree->addChild(mustBe("keyword", current()->getValue()));
+            tree->addChild(mustBe("keyword", currentValue()));
         }
-        else if (have("identifier", current()->getValue())){
+        else if (have("identifier", currentValue())){
             // add variable type
-            tree->addChild(mustBe("identifier", current()->getValue()));
+            tree->addChild(mustBe("identifier", currentValue()));
         }
 
-        tree->addChild(mustBe("identifier", current()->getValue()));
+        tree->addChild(mustBe("identifier", currentValue()));
     }
 
     return tree;
@@ -201,7 +215,7 @@ ParseTree* CompilerParser::compileParameterList() {
  */
 ParseTree* CompilerParser::compileSubroutineBody() {
     // create passtree
-    ParseTree* tree = new ParseTree("subroutineBody", "");
+    ParseTree* tree = newTree("subroutineBody");
 
     // add open bracket
     tree->addChild(mustBe("symbol", "{"));
@@ -215,7 +229,7 @@ ParseTree* CompilerParser::compileSubroutineBody() {
     }
     
     // add body
-    while (current() != NULL && (have("keyword", current()->getValue()) || have("symbol", ";"))){
+    while (current() != NULL && (have("keyword", currentValue()) || have("symbol", ";"))){
         if (have("symbol", ";")){
             tree->addChild(mustBe("symbol", ";"));
         }
@@ -241,28 +255,28 @@ ParseTree* CompilerParser::compileSubroutineBody() {
  */
 ParseTree* CompilerParser::compileVarDec() {
     // create passtree
-    ParseTree* tree = new ParseTree("varDec", "");
+    ParseTree* tree = newTree("varDec");
 
     // add keyword var
     tree->addChild(mustBe("keyword", "var"));
 
     // add keyword var type
-    if (have("keyword", current()->getValue())){
-        tree->addChild(mustBe("keyword", current()->getValue()));
+    if (have("keyword", currentValue())){
+        tree->addChild(mustBe("keyword", currentValue()));
     }
-    else if (have("identifier", current()->getValue())){
-        tree->addChild(mustBe("identifier", current()->getValue()));
+    else if (have("identifier", currentValue())){
+        tree->addChild(mustBe("identifier", currentValue()));
     }
     else{
         throw ParseException();
     }
 
     // add identifier
-    tree->addChild(mustBe("identifier", current()->getValue()));
+    tree->addChild(mustBe("identifier", currentValue()));
 
     while (current() != NULL && have("symbol", ",")){
         tree->addChild(mustBe("symbol", ","));
-        tree->addChild(mustBe("identifier", current()->getValue()));
+        tree->addChild(mustBe("identifier", currentValue()));
     }
 
     // add semi-colon
@@ -276,51 +290,7 @@ ParseTree* CompilerParser::compileVarDec() {
  * @return a ParseTree
  */
 ParseTree* CompilerParser::compileStatements() {
-    // create passtree
-    ParseTree* tree = new ParseTree("statements", "");
-
-    // first statement
-    if (have("keyword", "let")){
-        tree->addChild(compileLet());
-    }// statements
-    else if(have("keyword", "if")){
-        tree->addChild(compileIf());
-    }
-    else if(have("keyword", "while")){
-        tree->addChild(compileWhile());
-    }
-    else if(have("keyword", "do")){
-        tree->addChild(compileDo());
-    }
-    else if(have("keyword", "return")){
-        tree->addChild(compileReturn());
-    }
-    
-    // subsequent statements
-    while (current() != NULL && (have("symbol", ";") || have("keyword", current()->getValue()))){
-        if (have("symbol", ";")){
-            tree->addChild(mustBe("symbol", ";"));
-        }
-        
-        // statements types
-        if (have("keyword", "let")){
-            tree->addChild(compileLet());
-        }// statements
-        else if(have("keyword", "if")){
-            tree->addChild(compileIf());
-        }
-        else if(have("keyword", "while")){
-            tree->addChild(compileWhile());
-        }
-        else if(have("keyword", "do")){
-            tree->addChild(compileDo());
-        }
-        else if(have("keyword", "return")){
-            tree->addChild(compileReturn());
-        }
-    }
-
-    return tree;
+    return parse(STATEMENTS);
 }
 
 /**
@@ -328,32 +298,7 @@ ParseTree* CompilerParser::compileStatements() {
  * @return a ParseTree
  */
 ParseTree* CompilerParser::compileLet() {
-    // create passtree
-    ParseTree* tree = new ParseTree("letStatement", "");
-
-    // add keyword let
-    tree->addChild(mustBe("keyword", "let"));
-
-    // add variable
-    tree->addChild(mustBe("identifier", current()->getValue()));
-
-    if (have("symbol", "[")){
-        tree->addChild(mustBe("symbol", "["));
-        // add expression 1
-        tree->addChild(compileExpression());
-        tree->addChild(mustBe("symbol", "]"));
-    }
-
-    // add '='
-    tree->addChild(mustBe("symbol", "="));
-
-    // add expression 2
-    tree->addChild(compileExpression());
-
-    // add semi-colon
-    tree->addChild(mustBe("symbol", ";"));
-
-    return tree;
+    return parse(LET);
 }
 
 /**
@@ -361,46 +306,7 @@ ParseTree* CompilerParser::compileLet() {
  * @return a ParseTree
  */
 ParseTree* CompilerParser::compileIf() {
-    // create passtree
-    ParseTree* tree = new ParseTree("ifStatement", "");
-
-    // add keyword if
-    tree->addChild(mustBe("keyword", "if"));
-
-    // add open bracket
-    tree->addChild(mustBe("symbol", "("));
-
-    // add expression
-    tree->addChild(compileExpression());
-
-    // add close bracket
-    tree->addChild(mustBe("symbol", ")"));
-
-    // add open bracket
-    tree->addChild(mustBe("symbol", "{"));
-
-    // add statements
-    tree->addChild(compileStatements());
-
-    // add closed brackets
-    tree->addChild(mustBe("symbol", "}"));
-
-    // else functionality
-    while (current() != NULL && have("keyword", "else")){
-        // add else
-        tree->addChild(mustBe("keyword", "else"));
-        
-        // add open bracket
-        tree->addChild(mustBe("symbol", "{"));
-
-        // add statements
-        tree->addChild(compileStatements());
-
-        // add closed brackets
-        tree->addChild(mustBe("symbol", "}"));
-    }
-
-    return tree;
+    return parse(IF);
 }
 
 /**
@@ -408,31 +314,7 @@ ParseTree* CompilerParser::compileIf() {
  * @return a ParseTree
  */
 ParseTree* CompilerParser::compileWhile() {
-    // create passtree
-    ParseTree* tree = new ParseTree("whileStatement", "");
-
-    // add keyword while
-    tree->addChild(mustBe("keyword", "while"));
-
-    // add open bracket
-    tree->addChild(mustBe("symbol", "("));
-
-    // add expression
-    tree->addChild(compileExpression());
-
-    // add close bracket
-    tree->addChild(mustBe("symbol", ")"));
-
-    // add open bracket
-    tree->addChild(mustBe("symbol", "{"));
-
-    // add statements
-    tree->addChild(compileStatements());
-
-    // add closed brackets
-    tree->addChild(mustBe("symbol", "}"));
-
-    return tree;
+    return parse(WHILE);
 }
 
 /**
@@ -440,19 +322,7 @@ ParseTree* CompilerParser::compileWhile() {
  * @return a ParseTree
  */
 ParseTree* CompilerParser::compileDo() {
-    // create passtree
-    ParseTree* tree = new ParseTree("doStatement", "");
-
-    // add keyword do
-    tree->addChild(mustBe("keyword", "do"));
-
-    // add expression
-    tree->addChild(compileExpression());
-
-    // add semi-colon
-    tree->addChild(mustBe("symbol", ";"));
-
-    return tree;
+    return parse(DO);
 }
 
 /**
@@ -460,21 +330,7 @@ ParseTree* CompilerParser::compileDo() {
  * @return a ParseTree
  */
 ParseTree* CompilerParser::compileReturn() {
-    // create passtree
-    ParseTree* tree = new ParseTree("returnStatement", "");
-
-    // add keyword rerturn
-    tree->addChild(mustBe("keyword", "return"));
-
-    if (!have("symbol", ";")){
-        // add expression
-        tree->addChild(compileExpression());
-    }
-
-    // add semi-colon
-    tree->addChild(mustBe("symbol", ";"));
-
-    return tree;
+    return parse(RETURN);
 }
 
 /**
@@ -482,25 +338,7 @@ ParseTree* CompilerParser::compileReturn() {
  * @return a ParseTree
  */
 ParseTree* CompilerParser::compileExpression() {
-    // create passtree
-    ParseTree* tree = new ParseTree("expression", "");
-
-    if (have("keyword", "skip")){
-        // add keyword skip
-        tree->addChild(mustBe("keyword", "skip"));
-    }
-    else{
-        //if (current() != NULL && (have("identifier", current()->getValue()) || have("keyword", current()->getValue()) || have("integerConstant", current()->getValue()))){
-        
-        while (current() != NULL && !(have("symbol", ")") || have("symbol", ","))){
-            tree->addChild(compileTerm());
-            if (current() != NULL && (have("symbol", "+") || have("symbol", "-") || have("symbol", "*") || have("symbol", "/") || have("symbol", "=") || have("symbol", ">") || have("symbol", "<") || have("symbol", "&") || have("symbol", "|"))){
-                tree->addChild(mustBe("symbol", current()->getValue()));
-            }
-        }
-    }
-
-    return tree;
+    return parse(EXPRESSION);
 }
 
 /**
@@ -508,76 +346,447 @@ ParseTree* CompilerParser::compileExpression() {
  * @return a ParseTree
  */
 ParseTree* CompilerParser::compileTerm() {
-    // create passtree
-    ParseTree* tree = new ParseTree("term", "");
+    return parse(TERM);
+}
 
-    if (have("integerConstant", current()->getValue())){
-        // add integer
-        tree->addChild(mustBe("integerConstant", current()->getValue()));
-    }
-    else if (have("identifier", current()->getValue())){
-        tree->addChild(mustBe("identifier", current()->getValue()));
+/**
+ * Generates a parse tree for an expression list
+ * @return a ParseTree
+ */
+ParseTree* CompilerParser::compileExpressionList() {
+    return parse(EXPRESSION_LIST);
+}
 
-        // add expression if 'varName[expression]'
-        if (current() != NULL){
-            if (have("symbol", "[")){
-                tree->addChild(mustBe("symbol", "["));
-                tree->addChild(compileExpression());
-                tree->addChild(mustBe("symbol", "]"));
-            }
-            // subroutineCall
-            else if (have("symbol", "(")){
-                tree->addChild(mustBe("symbol", "("));
-                tree->addChild(compileExpressionList());
-                tree->addChild(mustBe("symbol", ")"));
-            }
-            else if (have("symbol", ".")){
-                tree->addChild(mustBe("symbol", "."));
-                tree->addChild(mustBe("identifier", current()->getValue()));
-                tree->addChild(mustBe("symbol", "("));
-                tree->addChild(compileExpressionList());
-                tree->addChild(mustBe("symbol", ")"));
-            }
+/**
+ * Generates a parse tree for a statement or expression production without recursing on the call stack.
+ * Each production in progress is a Frame on an explicit stack. A frame's state records how far through
+ * its production it is, and a nested production is added to its parent's tree and pushed on top,
+ * so nesting depth only grows the heap-allocated stack.
+ * @param production The production to parse
+ * @return a ParseTree
+ */
+ParseTree* CompilerParser::parse(Production production) {
+    DepthGuard guard(this);
+
+    ParseTree* root = newTree(productionType(production));
+    std::vector<Frame> stack;
+    stack.push_back(Frame{production, root, 0});
+
+    while (!stack.empty()) {
+        Frame& frame = stack.back();
+        ParseTree* tree = frame.tree;
+
+        switch (frame.production) {
+            case STATEMENTS:
+                if (frame.state == 0) {
+                    // first statement
+                    frame.state = 1;
+                    if (isStatement()) {
+                        push(stack, statementProduction(), tree);
+                    }
+                }
+                else if (current() != NULL && (have("symbol", ";") || have("keyword", currentValue()))) {
+                    // subsequent statements
+                    if (have("symbol", ";")) {
+                        tree->addChild(mustBe("symbol", ";"));
+                    }
+                    if (isStatement()) {
+                        push(stack, statementProduction(), tree);
+                    }
+                }
+                else {
+                    stack.pop_back();
+                }
+                break;
+
+            case LET:
+                if (frame.state == 0) {
+                    // add keyword let and variable
+                    tree->addChild(mustBe("keyword", "let"));
+                    tree->addChild(mustBe("identifier", currentValue()));
+                    if (have("symbol", "[")) {
+                        tree->addChild(mustBe("symbol", "["));
+                        frame.state = 1;
+                        push(stack, EXPRESSION, tree);
+                    }
+                    else {
+                        frame.state = 2;
+                    }
+                }
+                else if (frame.state == 1) {
+                    tree->addChild(mustBe("symbol", "]"));
+                    frame.state = 2;
+                }
+                else if (frame.state == 2) {
+                    // add '=' and expression
+                    tree->addChild(mustBe("symbol", "="));
+                    frame.state = 3;
+                    push(stack, EXPRESSION, tree);
+                }
+                else {
+                    tree->addChild(mustBe("symbol", ";"));
+                    stack.pop_back();
+                }
+                break;
+
+            case IF:
+                if (frame.state == 0) {
+                    // add keyword if and condition
+                    tree->addChild(mustBe("keyword", "if"));
+                    tree->addChild(mustBe("symbol", "("));
+                    frame.state = 1;
+                    push(stack, EXPRESSION, tree);
+                }
+                else if (frame.state == 1) {
+                    // add body
+                    tree->addChild(mustBe("symbol", ")"));
+                    tree->addChild(mustBe("symbol", "{"));
+                    frame.state = 2;
+                    push(stack, STATEMENTS, tree);
+                }
+                else if (frame.state == 2) {
+                    tree->addChild(mustBe("symbol", "}"));
+                    frame.state = 3;
+                }
+                else if (current() != NULL && have("keyword", "else")) {
+                    // else functionality
+                    tree->addChild(mustBe("keyword", "else"));
+                    tree->addChild(mustBe("symbol", "{"));
+                    frame.state = 2;
+                    push(stack, STATEMENTS, tree);
+                }
+                else {
+                    stack.pop_back();
+                }
+                break;
+
+            case WHILE:
+                if (frame.state == 0) {
+                    // add keyword while and condition
+                    tree->addChild(mustBe("keyword", "while"));
+                    tree->addChild(mustBe("symbol", "("));
+                    frame.state = 1;
+                    push(stack, EXPRESSION, tree);
+                }
+                else if (frame.state == 1) {
+                    // add body
+                    tree->addChild(mustBe("symbol", ")"));
+                    tree->addChild(mustBe("symbol", "{"));
+                    frame.state = 2;
+                    push(stack, STATEMENTS, tree);
+                }
+                else {
+                    tree->addChild(mustBe("symbol", "}"));
+                    stack.pop_back();
+                }
+                break;
+
+            case DO:
+                if (frame.state == 0) {
+                    tree->addChild(mustBe("keyword", "do"));
+                    frame.state = 1;
+                    push(stack, EXPRESSION, tree);
+                }
+                else {
+                    tree->addChild(mustBe("symbol", ";"));
+                    stack.pop_back();
+                }
+                break;
+
+            case RETURN:
+                if (frame.state == 0) {
+                    tree->addChild(mustBe("keyword", "return"));
+                    frame.state = 1;
+                    if (!have("symbol", ";")) {
+                        push(stack, EXPRESSION, tree);
+                    }
+                }
+                else {
+                    tree->addChild(mustBe("symbol", ";"));
+                    stack.pop_back();
+                }
+                break;
+
+            case EXPRESSION:
+                if (frame.state == 0) {
+                    frame.state = 1;
+                    if (have("keyword", "skip")) {
+                        // add keyword skip
+                        tree->addChild(mustBe("keyword", "skip"));
+                        stack.pop_back();
+                    }
+                }
+                else if (frame.state == 1) {
+                    // add terms until the expression is closed
+                    if (current() != NULL && !(have("symbol", ")") || have("symbol", ","))) {
+                        frame.state = 2;
+                        push(stack, TERM, tree);
+                    }
+                    else {
+                        stack.pop_back();
+                    }
+                }
+                else {
+                    // add operator between terms
+                    if (current() != NULL && (have("symbol", "+") || have("symbol", "-") || have("symbol", "*") || have("symbol", "/") || have("symbol", "=") || have("symbol", ">") || have("symbol", "<") || have("symbol", "&") || have("symbol", "|"))) {
+                        tree->addChild(mustBe("symbol", currentValue()));
+                    }
+                    frame.state = 1;
+                }
+                break;
+
+            case TERM:
+                if (frame.state == 1) {
+                    tree->addChild(mustBe("symbol", "]"));
+                    stack.pop_back();
+                }
+                else if (frame.state == 2) {
+                    tree->addChild(mustBe("symbol", ")"));
+                    stack.pop_back();
+                }
+                else if (current() == NULL) {
+                    throw ParseException();
+                }
+                else if (have("integerConstant", currentValue())) {
+                    // add integer
+                    tree->addChild(mustBe("integerConstant", currentValue()));
+                    stack.pop_back();
+                }
+                else if (have("identifier", currentValue())) {
+                    tree->addChild(mustBe("identifier", currentValue()));
+
+                    // add expression if 'varName[expression]'
+                    if (have("symbol", "[")) {
+                        tree->addChild(mustBe("symbol", "["));
+                        frame.state = 1;
+                        push(stack, EXPRESSION, tree);
+                    }
+                    // subroutineCall
+                    else if (have("symbol", "(")) {
+                        tree->addChild(mustBe("symbol", "("));
+                        frame.state = 2;
+                        push(stack, EXPRESSION_LIST, tree);
+                    }
+                    else if (have("symbol", ".")) {
+                        tree->addChild(mustBe("symbol", "."));
+                        tree->addChild(mustBe("identifier", currentValue()));
+                        tree->addChild(mustBe("symbol", "("));
+                        frame.state = 2;
+                        push(stack, EXPRESSION_LIST, tree);
+                    }
+                    else {
+                        stack.pop_back();
+                    }
+                }
+                else if (have("stringConstant", currentValue())) {
+                    tree->addChild(mustBe("stringConstant", currentValue()));
+                    stack.pop_back();
+                }
+                else if (have("symbol", "(")) {
+                    tree->addChild(mustBe("symbol", "("));
+                    frame.state = 2;
+                    push(stack, EXPRESSION, tree);
+                }
+                else if (have("keyword", "function") || have("keyword", "constructor") || have("keyword", "method")) {
+                    // subroutines still recurse, bounded by the depth guard
+                    tree->addChild(compileSubroutine());
+                    stack.pop_back();
+                }
+                else if (have("keyword", "true") || have("keyword", "false") || have("keyword", "null") || have("keyword", "this")) {
+                    tree->addChild(mustBe("keyword", currentValue()));
+                    stack.pop_back();
+                }
+                else {
+                    throw ParseException();
+                }
+                break;
+
+            case EXPRESSION_LIST:
+                if (frame.state == 0) {
+                    // add first expression
+                    frame.state = 1;
+                    push(stack, EXPRESSION, tree);
+                }
+                else if (current() != NULL && have("symbol", ",")) {
+                    // add subsequent expressions
+                    tree->addChild(mustBe("symbol", ","));
+                    push(stack, EXPRESSION, tree);
+                }
+                else {
+                    stack.pop_back();
+                }
+                break;
         }
     }
-    else if (have("stringConstant", current()->getValue())){
-        tree->addChild(mustBe("stringConstant", current()->getValue()));
+
+    return root;
+}
+
+/**
+ * Start parsing a nested production: add its tree to the parent's and push a frame for it.
+ * This may reallocate the stack, so callers must not use a Frame reference afterwards.
+ * @param stack The parse stack
+ * @param production The nested production
+ * @param parent The tree of the production it is nested in
+ */
+void CompilerParser::push(std::vector<Frame>& stack, Production production, ParseTree* parent) {
+    ParseTree* tree = newTree(productionType(production));
+    parent->addChild(tree);
+    stack.push_back(Frame{production, tree, 0});
+}
+
+/**
+ * Get the parse tree type for a production
+ * @return the type of node (see element types)
+ */
+std::string CompilerParser::productionType(Production production) {
+    switch (production) {
+        case STATEMENTS: return "statements";
+        case LET: return "letStatement";
+        case IF: return "ifStatement";
+        case WHILE: return "whileStatement";
+        case DO: return "doStatement";
+        case RETURN: return "returnStatement";
+        case EXPRESSION: return "expression";
+        case TERM: return "term";
+        case EXPRESSION_LIST: return "expressionList";
+    }
+    return "";
+}
+
+/**
+ * Check if the current token starts a statement
+ * @return true if it is let, if, while, do or return, false otherwise
+ */
+bool CompilerParser::isStatement() {
+    return have("keyword", "let") || have("keyword", "if") || have("keyword", "while") || have("keyword", "do") || have("keyword", "return");
+}
+
+/**
+ * Get the production for the statement the current token starts
+ * @return the statement's production
+ */
+CompilerParser::Production CompilerParser::statementProduction() {
+    if (have("keyword", "let")) {
+        return LET;
     }
-    else if (have("symbol", "(")){
-        tree->addChild(mustBe("symbol", "("));
-        tree->addChild(compileExpression());
-        tree->addChild(mustBe("symbol", ")"));
+    else if (have("keyword", "if")) {
+        return IF;
     }
-    else if (have("keyword", "function") || have("keyword", "constructor") || have("keyword", "method")){
-        tree->addChild(compileSubroutine());
+    else if (have("keyword", "while")) {
+        return WHILE;
     }
-    else if (have("keyword", "true") || have("keyword", "false") || have("keyword", "null") || have("keyword", "this")){
-        tree->addChild(mustBe("keyword", current()->getValue()));
+    else if (have("keyword", "do")) {
+        return DO;
     }
-    else{
-        throw ParseException();
+    return RETURN;
+}
+
+/**
+ * Generates a parse tree for each of many small fragments, reusing this parser for all of them.
+ * A fragment's production is one of "class", "statements", "expression", "expressionList" or "term".
+ * Each fragment's tokens are moved into the parser rather than copied, so the fragments are left empty.
+ * Every node built for a fragment is noted in a scratch list, so a fragment that fails frees all of its nodes,
+ * including partial trees abandoned by a ParseException.
+ * @param fragments The fragments to parse
+ * @return One ParseTree per fragment, in order, or NULL where the fragment failed to parse or had tokens left over.
+ *         Release the trees with freeFragments().
+ */
+std::vector<ParseTree*> CompilerParser::compileFragments(std::list<Fragment>& fragments) {
+    TraceSpan span("compileFragments", "parse");
+
+    std::vector<ParseTree*> results;
+    results.reserve(fragments.size());
+
+    std::vector<ParseTree*> nodes;
+    scratch = &nodes;
+
+    for (Fragment& fragment : fragments) {
+        tokens.clear();
+        tokens.splice(tokens.end(), fragment.tokens);
+        nodes.clear();
+
+        ParseTree* tree = NULL;
+        try {
+            if (fragment.production == "class") {
+                tree = compileClass();
+            }
+            else if (fragment.production == "statements") {
+                tree = compileStatements();
+            }
+            else if (fragment.production == "expression") {
+                tree = compileExpression();
+            }
+            else if (fragment.production == "expressionList") {
+                tree = compileExpressionList();
+            }
+            else if (fragment.production == "term") {
+                tree = compileTerm();
+            }
+
+            if (current() != NULL) {
+                tree = NULL;
+            }
+        } catch (ParseException& e) {
+            tree = NULL;
+        }
+
+        // tokens are the caller's; only the nodes built here are freed
+        if (tree == NULL) {
+            for (ParseTree* node : nodes) {
+                delete node;
+            }
+        }
+
+        results.push_back(tree);
     }
 
-    return tree;
+    scratch = NULL;
+    tokens.clear();
+    return results;
 }
 
 /**
- * Generates a parse tree for an expression list
- * @return a ParseTree
+ * Free the trees returned by compileFragments(). Each tree's non-terminal nodes are deleted;
+ * its leaves are input tokens, which belong to the caller and are left alone.
+ * Walks an explicit stack so that trees of any depth can be freed.
+ * @param results The trees to free. Every entry is set to NULL.
  */
-ParseTree* CompilerParser::compileExpressionList() {
-    // create passtree
-    ParseTree* tree = new ParseTree("expressionList", "");
+void CompilerParser::freeFragments(std::vector<ParseTree*>& results) {
+    std::vector<ParseTree*> stack;
+    for (ParseTree*& result : results) {
+        if (result != NULL) {
+            stack.push_back(result);
+            result = NULL;
+        }
+    }
 
-    // add first expression
-    tree->addChild(compileExpression());
+    while (!stack.empty()) {
+        ParseTree* node = stack.back();
+        stack.pop_back();
 
-    // add subsequent expressions
-    while (current() != NULL && have("symbol", ",")){
-        tree->addChild(mustBe("symbol", ","));
-        tree->addChild(compileExpression());
+        const std::string& type = node->getType();
+        if (type == "keyword" || type == "symbol" || type == "identifier" || type == "integerConstant" || type == "stringConstant") {
+            continue;
+        }
+
+        for (ParseTree* child : node->getChildren()) {
+            stack.push_back(child);
+        }
+        delete node;
     }
+}
 
+/**
+ * Create a non-terminal node, noting it in the scratch list while compileFragments() is running
+ * @param type The type of node (see element types)
+ * @return the new ParseTree
+ */
+ParseTree* CompilerParser::newTree(const std::string& type) {
+    ParseTree* tree = new ParseTree(type, "");
+    if (scratch != NULL) {
+        scratch->push_back(tree);
+    }
     return tree;
 }
 
@@ -591,18 +800,33 @@ void CompilerParser::next(){
 
 /**
  * Return the current token
- * @return the Token
+ * @return the Token, or NULL once every token has been consumed
  */
 Token* CompilerParser::current(){
+    if (tokens.empty()){
+        return NULL;
+    }
     return tokens.front();
 }
 
+/**
+ * Return the current token's value
+ * Throws a ParseException if every token has been consumed.
+ * @return the current token's value
+ */
+const std::string& CompilerParser::currentValue(){
+    if (current() == NULL){
+        throw ParseException();
+    }
+    return current()->getValue();
+}
+
 /**
  * Check if the current token matches the expected type and value.
  * @return true if a match, false otherwise
  */
-bool CompilerParser::have(std::string expectedType, std::string expectedValue){
-    if (current()->getType() == expectedType && current()->getValue() == expectedValue){
+bool CompilerParser::have(const std::string& expectedType, const std::string& expectedValue){
+    if (current() != NULL && current()->getType() == expectedType && current()->getValue() == expectedValue){
         return true;
     }
     else{
@@ -613,11 +837,13 @@ bool CompilerParser::have(std::string expectedType, std::string expectedValue){
 /**
  * Check if the current token matches the expected type and value.
  * If so, advance to the next token, returning the current token, otherwise throw a ParseException.
+ * The returned token is the caller's input token, not a copy, and becomes a leaf of the tree being built.
  * @return the current token before advancing
  */
-Token* CompilerParser::mustBe(std::string expectedType, std::string expectedValue){
+Token* CompilerParser::mustBe(const std::string& expectedType, const std::string& expectedValue){
     if (have(expectedType, expectedValue) == true){
-        Token* curr = new Token(expectedType, expectedValue);
+        // hand back the token itself rather than allocating a copy of it
+        Token* curr = current();
         next();
         return curr;
     }
@@ -626,6 +852,26 @@ Token* CompilerParser::mustBe(std::string expectedType, std::string expectedValu
     }
 }
 
+/**
+ * Enter a production that recurses on the call stack.
+ * Throws a ParseException once nesting passes maxDepth, before the call stack can overflow.
+ * @param parser The parser whose depth to track
+ */
+CompilerParser::DepthGuard::DepthGuard(CompilerParser* parser){
+    this->parser = parser;
+    if (parser->depth >= parser->maxDepth){
+        throw ParseException();
+    }
+    parser->depth++;
+}
+
+/**
+ * Leave the production, including when a ParseException unwinds through it
+ */
+CompilerParser::DepthGuard::~DepthGuard(){
+    parser->depth--;
+}
+
 /**
  * Definition of a ParseException
  * You can use this ParseException with `throw ParseException();`
@@ -2,14 +2,27 @@
 #define COMPILERPARSER_H
 
 #include <list>
+#include <string>
+#include <vector>
 #include <exception>
 
 #include "ParseTree.h"
 #include "Token.h"
 
+struct Fragment {
+    std::string production;
+    std::list<Token*> tokens;
+};
+
+/*
+ * Parse trees returned by CompilerParser use the Token objects from its input as their leaves; they are not copied.
+ * The tokens must outlive every tree built from them, and the same token may appear in several trees
+ * when one token list is parsed more than once. A tree owns only its non-terminal nodes;
+ * freeFragments() releases them for the results of compileFragments().
+ */
 class CompilerParser {
     public:
-        CompilerParser(std::list<Token*> tokens);
+        CompilerParser(std::list<Token*> tokens, int maxDepth = 1000);
 
         ParseTree* compileProgram();
         ParseTree* compileClass();
@@ -29,14 +42,45 @@ class CompilerParser {
         ParseTree* compileExpression();
         ParseTree* compileTerm();
         ParseTree* compileExpressionList();
+
+        std::vector<ParseTree*> compileFragments(std::list<Fragment>& fragments);
+        void freeFragments(std::vector<ParseTree*>& results);
         
         void next();
         Token* current();
-        bool have(std::string expectedType, std::string expectedValue);
-        Token* mustBe(std::string expectedType, std::string expectedValue);
+        const std::string& currentValue();
+        bool have(const std::string& expectedType, const std::string& expectedValue);
+        Token* mustBe(const std::string& expectedType, const std::string& expectedValue);
 
     private:
+        enum Production { STATEMENTS, LET, IF, WHILE, DO, RETURN, EXPRESSION, TERM, EXPRESSION_LIST };
+
+        struct Frame {
+            Production production;
+            ParseTree* tree;
+            int state;
+        };
+
+        class DepthGuard {
+            public:
+                DepthGuard(CompilerParser* parser);
+                ~DepthGuard();
+
+            private:
+                CompilerParser* parser;
+        };
+
         std::list<Token*> tokens;
+        int depth;
+        int maxDepth;
+        std::vector<ParseTree*>* scratch;
+
+        ParseTree* parse(Production production);
+        void push(std::vector<Frame>& stack, Production production, ParseTree* parent);
+        std::string productionType(Production production);
+        bool isStatement();
+        Production statementProduction();
+        ParseTree* newTree(const std::string& type);
 };
 
 class ParseException : public std::exception {
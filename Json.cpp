@@ -0,0 +1,33 @@
+#include "Json.h"
+
+#include <cstdio>
+
+/**
+ * Escape text for use inside a JSON string
+ * @param text The text to escape
+ * @return The text with quotes, backslashes and control characters escaped
+ */
+std::string jsonEscape(const std::string& text) {
+    std::string output = "";
+    for (char c : text) {
+        if (c == '"' || c == '\\') {
+            output += '\\';
+            output += c;
+        }
+        else if (c == '\n') {
+            output += "\\n";
+        }
+        else if (c == '\t') {
+            output += "\\t";
+        }
+        else if (static_cast<unsigned char>(c) < 0x20) {
+            char code[7];
+            snprintf(code, sizeof(code), "\\u%04x", c);
+            output += code;
+        }
+        else {
+            output += c;
+        }
+    }
+    return output;
+}
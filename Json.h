@@ -0,0 +1,8 @@
+#ifndef JSON_H
+#define JSON_H
+
+#include <string>
+
+std::string jsonEscape(const std::string& text);
+
+#endif /*JSON_H*/
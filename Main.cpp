@@ -1,12 +1,72 @@
 #include <iostream>
 #include <list>
+#include <chrono>
+#include <cstdlib>
+#include <string>
 
 #include "CompilerParser.h"
+#include "MemoryStats.h"
+#include "SemanticChecker.h"
 #include "Token.h"
+#include "Trace.h"
 
 using namespace std;
 
+/**
+ * Tokens for subroutines declared inside terms, nested `levels` deep:
+ *     function void f() { if (function void f() { if (...) { } }) { } }
+ * Each level recurses through compileSubroutine() and counts towards the parser's depth limit.
+ */
+list<Token*> nestedSubroutines(int levels) {
+    list<Token*> tokens;
+    for (int i = 0; i < levels; i++) {
+        tokens.push_back(new Token("keyword", "function"));
+        tokens.push_back(new Token("keyword", "void"));
+        tokens.push_back(new Token("identifier", "f"));
+        tokens.push_back(new Token("symbol", "("));
+        tokens.push_back(new Token("symbol", ")"));
+        tokens.push_back(new Token("symbol", "{"));
+        tokens.push_back(new Token("keyword", "if"));
+        tokens.push_back(new Token("symbol", "("));
+    }
+    tokens.push_back(new Token("integerConstant", "1"));
+    for (int i = 0; i < levels; i++) {
+        tokens.push_back(new Token("symbol", ")"));
+        tokens.push_back(new Token("symbol", "{"));
+        tokens.push_back(new Token("symbol", "}"));
+        tokens.push_back(new Token("symbol", "}"));
+    }
+    return tokens;
+}
+
 int main(int argc, char *argv[]) {
+    // `--bench N` parses N copies of the expression list below as one batch
+    // `--memory FILE` writes node counts and bytes per section and node type as JSON
+    // `--trace FILE` writes a Chrome trace of parsing and checking, one lane per thread
+    int benchCount = 0;
+    string memoryFile = "";
+    string traceFile = "";
+    for (int i = 1; i + 1 < argc; i += 2) {
+        string flag = argv[i];
+        if (flag == "--bench") {
+            benchCount = atoi(argv[i + 1]);
+        }
+        else if (flag == "--memory") {
+            memoryFile = argv[i + 1];
+        }
+        else if (flag == "--trace") {
+            traceFile = argv[i + 1];
+        }
+    }
+    if (memoryFile != "") {
+        MemoryStats::enable();
+    }
+    if (traceFile != "") {
+        Trace::enable();
+    }
+
+    MemoryStats::section("expressionList demo");
+
     /* Tokens for:
      *     class MyClass {
      *
@@ -31,4 +91,165 @@ int main(int argc, char *argv[]) {
     } catch (ParseException e) {
         cout << "Error Parsing!" << endl;
     }
-}
\ No newline at end of file
+
+    MemoryStats::section("class demo");
+
+    /* Tokens for:
+     *     class Main {
+     *         function void main() {
+     *             var int y;
+     *             if (Main.f(x, y)) { }
+     *         }
+     *         method void f(int a) { }
+     *     }
+     * which calls method f through its class, with two arguments instead of one, and uses an undeclared x
+     */
+    string classTokens[][2] = {
+        {"keyword", "class"}, {"identifier", "Main"}, {"symbol", "{"},
+        {"keyword", "function"}, {"keyword", "void"}, {"identifier", "main"}, {"symbol", "("}, {"symbol", ")"}, {"symbol", "{"},
+        {"keyword", "var"}, {"keyword", "int"}, {"identifier", "y"}, {"symbol", ";"},
+        {"keyword", "if"}, {"symbol", "("}, {"identifier", "Main"}, {"symbol", "."}, {"identifier", "f"}, {"symbol", "("},
+        {"identifier", "x"}, {"symbol", ","}, {"identifier", "y"}, {"symbol", ")"}, {"symbol", ")"}, {"symbol", "{"}, {"symbol", "}"},
+        {"symbol", "}"},
+        {"keyword", "method"}, {"keyword", "void"}, {"identifier", "f"}, {"symbol", "("}, {"keyword", "int"}, {"identifier", "a"}, {"symbol", ")"},
+        {"symbol", "{"}, {"symbol", "}"},
+        {"symbol", "}"}
+    };
+    list<Token*> program;
+    for (auto& token : classTokens) {
+        program.push_back(new Token(token[0], token[1]));
+    }
+
+    list<ParseTree*> classes;
+    try {
+        CompilerParser parser(program);
+        classes.push_back(parser.compileClass());
+    } catch (ParseException& e) {
+        cout << "Error Parsing!" << endl;
+    }
+
+    SemanticChecker checker(classes);
+    try {
+        checker.check();
+        cout << "No semantic errors" << endl;
+    } catch (SemanticException& e) {
+        for (string error : checker.getErrors()) {
+            cout << error << endl;
+        }
+    }
+
+    /* Tokens for:
+     *     class Deep {
+     *         function void main() {
+     *             var int x;
+     *             while (x) { while (x) { ... } }
+     *         }
+     *     }
+     * with 100000 nested whiles. Expressions and statements nest on the parser's own stack
+     * and the checker walks the tree with a worklist, so both handle it.
+     */
+    MemoryStats::section("nesting");
+    string deepHeader[][2] = {
+        {"keyword", "class"}, {"identifier", "Deep"}, {"symbol", "{"},
+        {"keyword", "function"}, {"keyword", "void"}, {"identifier", "main"}, {"symbol", "("}, {"symbol", ")"}, {"symbol", "{"},
+        {"keyword", "var"}, {"keyword", "int"}, {"identifier", "x"}, {"symbol", ";"}
+    };
+    list<Token*> nestedWhiles;
+    for (auto& token : deepHeader) {
+        nestedWhiles.push_back(new Token(token[0], token[1]));
+    }
+    for (int i = 0; i < 100000; i++) {
+        nestedWhiles.push_back(new Token("keyword", "while"));
+        nestedWhiles.push_back(new Token("symbol", "("));
+        nestedWhiles.push_back(new Token("identifier", "x"));
+        nestedWhiles.push_back(new Token("symbol", ")"));
+        nestedWhiles.push_back(new Token("symbol", "{"));
+    }
+    for (int i = 0; i < 100000; i++) {
+        nestedWhiles.push_back(new Token("symbol", "}"));
+    }
+    nestedWhiles.push_back(new Token("symbol", "}"));
+    nestedWhiles.push_back(new Token("symbol", "}"));
+
+    list<ParseTree*> deepClasses;
+    try {
+        CompilerParser parser(nestedWhiles);
+        deepClasses.push_back(parser.compileClass());
+        cout << "100000 nested while statements: parsed" << endl;
+    } catch (ParseException& e) {
+        cout << "100000 nested while statements: Error Parsing!" << endl;
+    }
+
+    SemanticChecker deepChecker(deepClasses);
+    try {
+        deepChecker.check();
+        cout << "100000 nested while statements: no semantic errors" << endl;
+    } catch (SemanticException& e) {
+        cout << "100000 nested while statements: " << deepChecker.getErrors().size() << " semantic errors" << endl;
+    }
+
+    list<Token*> nestedParentheses;
+    for (int i = 0; i < 100000; i++) {
+        nestedParentheses.push_back(new Token("symbol", "("));
+    }
+    nestedParentheses.push_back(new Token("integerConstant", "1"));
+    for (int i = 0; i < 100000; i++) {
+        nestedParentheses.push_back(new Token("symbol", ")"));
+    }
+    try {
+        CompilerParser parser(nestedParentheses);
+        parser.compileExpression();
+        cout << "100000 nested parentheses: parsed" << endl;
+    } catch (ParseException& e) {
+        cout << "100000 nested parentheses: Error Parsing!" << endl;
+    }
+
+    // subroutines inside terms recurse, one outer expression plus two levels each, up to the default limit of 1000
+    for (int levels : {499, 500}) {
+        try {
+            CompilerParser parser(nestedSubroutines(levels));
+            parser.compileExpression();
+            cout << levels << " nested subroutines: parsed" << endl;
+        } catch (ParseException& e) {
+            cout << levels << " nested subroutines: Error Parsing!" << endl;
+        }
+    }
+
+    if (benchCount > 0) {
+        MemoryStats::section("bench");
+        int count = benchCount;
+        list<Fragment> fragments;
+        for (int i = 0; i < count; i++) {
+            Fragment fragment;
+            fragment.production = "expressionList";
+            fragment.tokens = tokens;
+            fragments.push_back(fragment);
+        }
+
+        list<Token*> empty;
+        CompilerParser parser(empty);
+        auto start = chrono::steady_clock::now();
+        vector<ParseTree*> results = parser.compileFragments(fragments);
+        chrono::duration<double> seconds = chrono::steady_clock::now() - start;
+
+        int parsed = 0;
+        for (ParseTree* result : results) {
+            if (result != NULL) {
+                parsed++;
+            }
+        }
+        cout << parsed << "/" << count << " fragments in " << seconds.count() << "s, "
+             << count / seconds.count() << " fragments/sec" << endl;
+
+        parser.freeFragments(results);
+    }
+
+    if (memoryFile != "") {
+        MemoryStats::write(memoryFile);
+    }
+
+    // every checker and parser thread has finished by now
+    if (traceFile != "") {
+        Trace::write(traceFile);
+    }
+}
@@ -0,0 +1,189 @@
+#include "MemoryStats.h"
+#include "Json.h"
+
+#include <atomic>
+#include <fstream>
+#include <list>
+#include <map>
+#include <mutex>
+#include <sys/resource.h>
+
+namespace {
+    struct TypeStats {
+        long long count = 0;
+        long long bytes = 0;
+        long long children = 0;
+        long long childBytes = 0;
+    };
+
+    struct Section {
+        std::string name;
+        long long rssStartKb = 0;
+        long long rssEndKb = 0;
+        long long peakRssKb = 0;
+        bool peakIsSection = false;
+        std::map<std::string, TypeStats> types;
+    };
+
+    std::atomic<bool> accounting(false);
+    std::mutex statsLock;
+    std::list<Section> sections;
+    long long liveBytes = 0;
+    long long peakLiveBytes = 0;
+
+    // read a "Name:   1234 kB" field from /proc/self/status, or -1 where it is not available
+    long long statusKb(const std::string& field) {
+        std::ifstream status("/proc/self/status");
+        std::string line;
+        while (std::getline(status, line)) {
+            if (line.compare(0, field.size() + 1, field + ":") == 0) {
+                return std::stoll(line.substr(field.size() + 1));
+            }
+        }
+        return -1;
+    }
+
+    // reset the kernel's resident high-water mark so VmHWM covers only what follows
+    bool resetPeakRss() {
+        std::ofstream clearRefs("/proc/self/clear_refs");
+        clearRefs << "5";
+        clearRefs.flush();
+        return clearRefs.good();
+    }
+
+    // called with statsLock held
+    void startSection(const std::string& name) {
+        sections.push_back(Section());
+        Section& section = sections.back();
+        section.name = name;
+        section.peakIsSection = resetPeakRss();
+        section.rssStartKb = statusKb("VmRSS");
+    }
+
+    // called with statsLock held. Without a resettable VmHWM, fall back to the process's peak so far
+    void endSection() {
+        Section& section = sections.back();
+        section.rssEndKb = statusKb("VmRSS");
+        if (section.peakIsSection) {
+            section.peakRssKb = statusKb("VmHWM");
+        }
+        else {
+            struct rusage usage;
+            getrusage(RUSAGE_SELF, &usage);
+            section.peakRssKb = usage.ru_maxrss;
+        }
+    }
+
+    // called with statsLock held
+    Section& currentSection() {
+        if (sections.empty()) {
+            startSection("default");
+        }
+        return sections.back();
+    }
+}
+
+/**
+ * Start counting ParseTree and Token allocations. Until this is called nothing is recorded.
+ */
+void MemoryStats::enable() {
+    accounting = true;
+}
+
+/**
+ * Check if allocations are being counted
+ * @return true if accounting is enabled, false otherwise
+ */
+bool MemoryStats::enabled() {
+    return accounting;
+}
+
+/**
+ * Attribute allocations from now on to a new section, such as one input file
+ * @param name The section's name
+ */
+void MemoryStats::section(const std::string& name) {
+    if (!accounting) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> guard(statsLock);
+    if (!sections.empty()) {
+        endSection();
+    }
+    startSection(name);
+}
+
+/**
+ * Record a newly constructed node
+ * @param type The node's type
+ * @param nodeBytes The bytes allocated for the node object itself
+ * @param stringBytes The bytes allocated for its strings' heap buffers
+ */
+void MemoryStats::recordNode(const std::string& type, std::size_t nodeBytes, std::size_t stringBytes) {
+    std::lock_guard<std::mutex> guard(statsLock);
+    TypeStats& stats = currentSection().types[type];
+    stats.count++;
+    stats.bytes += nodeBytes + stringBytes;
+    liveBytes += nodeBytes;
+    if (liveBytes > peakLiveBytes) {
+        peakLiveBytes = liveBytes;
+    }
+}
+
+/**
+ * Record a child added to a node's child list
+ * @param parentType The type of the node the child was added to
+ * @param bytes The bytes allocated for the list entry
+ */
+void MemoryStats::recordChild(const std::string& parentType, std::size_t bytes) {
+    std::lock_guard<std::mutex> guard(statsLock);
+    TypeStats& stats = currentSection().types[parentType];
+    stats.children++;
+    stats.childBytes += bytes;
+}
+
+/**
+ * Record a freed node
+ * @param bytes The bytes the node's allocation released
+ */
+void MemoryStats::recordFree(std::size_t bytes) {
+    std::lock_guard<std::mutex> guard(statsLock);
+    liveBytes -= bytes;
+}
+
+/**
+ * Write the counts as JSON: per section and node type, the node count and bytes,
+ * the child list entries and their bytes, and resident memory at the section's start and end.
+ * Where the kernel allows the resident high-water mark to be reset, peakRssKb is the section's own peak;
+ * otherwise it is the process's peak so far and is written as processPeakRssKb instead.
+ * liveBytes and peakLiveBytes cover the ParseTree and Token objects themselves.
+ * @param filename The file to write
+ */
+void MemoryStats::write(const std::string& filename) {
+    std::lock_guard<std::mutex> guard(statsLock);
+    if (!sections.empty()) {
+        endSection();
+    }
+
+    std::ofstream out(filename);
+    out << "{\"sections\":[";
+    bool firstSection = true;
+    for (const Section& section : sections) {
+        out << (firstSection ? "" : ",") << "\n{\"name\":\"" << jsonEscape(section.name)
+            << "\",\"rssStartKb\":" << section.rssStartKb << ",\"rssEndKb\":" << section.rssEndKb
+            << (section.peakIsSection ? ",\"peakRssKb\":" : ",\"processPeakRssKb\":") << section.peakRssKb << ",\"types\":{";
+        firstSection = false;
+
+        bool firstType = true;
+        for (const auto& entry : section.types) {
+            const TypeStats& stats = entry.second;
+            out << (firstType ? "" : ",") << "\n  \"" << jsonEscape(entry.first) << "\":{\"count\":" << stats.count
+                << ",\"bytes\":" << stats.bytes << ",\"children\":" << stats.children
+                << ",\"childBytes\":" << stats.childBytes << "}";
+            firstType = false;
+        }
+        out << "}}";
+    }
+    out << "\n],\"liveBytes\":" << liveBytes << ",\"peakLiveBytes\":" << peakLiveBytes << "}\n";
+}
@@ -0,0 +1,18 @@
+#ifndef MEMORYSTATS_H
+#define MEMORYSTATS_H
+
+#include <cstddef>
+#include <string>
+
+class MemoryStats {
+    public:
+        static void enable();
+        static bool enabled();
+        static void section(const std::string& name);
+        static void recordNode(const std::string& type, std::size_t nodeBytes, std::size_t stringBytes);
+        static void recordChild(const std::string& parentType, std::size_t bytes);
+        static void recordFree(std::size_t bytes);
+        static void write(const std::string& filename);
+};
+
+#endif /*MEMORYSTATS_H*/
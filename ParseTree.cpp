@@ -1,7 +1,20 @@
 #include "ParseTree.h"
+#include "MemoryStats.h"
+
+#include <vector>
 
 using namespace std;
 
+namespace {
+    // size of the last ParseTree allocation on this thread, claimed by the constructor that follows it
+    thread_local size_t allocationSize = 0;
+
+    // heap bytes behind a string, or 0 while it fits in the small string buffer
+    size_t heapBytes(const string& text) {
+        return text.capacity() > string().capacity() ? text.capacity() + 1 : 0;
+    }
+}
+
 /**
  * A node in a Parse Tree data structure
  * @param type The type of node (see element types).
@@ -10,6 +23,34 @@ using namespace std;
 ParseTree::ParseTree(string type, string value) {
     ParseTree::type = type;
     ParseTree::value = value;
+
+    if (MemoryStats::enabled()) {
+        MemoryStats::recordNode(ParseTree::type, allocationSize, heapBytes(ParseTree::type) + heapBytes(ParseTree::value));
+    }
+    allocationSize = 0;
+}
+
+/**
+ * Allocate a ParseTree or Token, noting its size for MemoryStats
+ * @param size The bytes to allocate
+ * @return The allocated memory
+ */
+void* ParseTree::operator new(size_t size) {
+    void* memory = ::operator new(size);
+    allocationSize = size;
+    return memory;
+}
+
+/**
+ * Free a ParseTree or Token
+ * @param memory The memory to free
+ * @param size The bytes that were allocated
+ */
+void ParseTree::operator delete(void* memory, size_t size) {
+    if (MemoryStats::enabled()) {
+        MemoryStats::recordFree(size);
+    }
+    ::operator delete(memory);
 }
 
 /**
@@ -18,13 +59,18 @@ ParseTree::ParseTree(string type, string value) {
  */
 void ParseTree::addChild(ParseTree* child) {
     ParseTree::children.push_back(child);
+
+    if (MemoryStats::enabled()) {
+        // a std::list entry holds the pointer plus next and previous links
+        MemoryStats::recordChild(ParseTree::type, sizeof(ParseTree*) + 2 * sizeof(void*));
+    }
 }
 
 /**
  * Get a list of child nodes in the order they were added.
  * @return A LinkedList of ParseTrees
  */
-list<ParseTree*> ParseTree::getChildren() {
+const list<ParseTree*>& ParseTree::getChildren() {
     return ParseTree::children;
 }
 
@@ -32,7 +78,7 @@ list<ParseTree*> ParseTree::getChildren() {
  * Get the type of this Node
  * @return The type of node (see element types).
  */
-string ParseTree::getType() {
+const string& ParseTree::getType() {
     return ParseTree::type;
 }
 
@@ -40,7 +86,7 @@ string ParseTree::getType() {
  * Get the value of this Node
  * @return The node's value. This should only be used on terminal nodes/leaves, and empty otherwise.
  */
-string ParseTree::getValue() {
+const string& ParseTree::getValue() {
     return ParseTree::value;
 }
 
@@ -54,27 +100,63 @@ string ParseTree::tostring() {
 
 /**
  * Generate a string from this ParseTree
+ * Walks an explicit stack and appends to one string, so deep trees neither overflow the call stack
+ * nor copy each subtree's output into its parent's.
  * @return A printable representation of this ParseTree with indentation
  */
 string ParseTree::tostring(int depth) {
+    const string unit = "  \u2502 ";
+
     // Set indentation
     string indent = "";
     for (int i = 0; i < depth; i++) {
-        indent += "  \u2502 ";
+        indent += unit;
     }
 
+    // Nodes with children whose remaining children are still to be printed
+    struct Pending {
+        ParseTree* node;
+        list<ParseTree*>::const_iterator next;
+    };
+    vector<Pending> stack;
+
     // Generate output
     string output = "";
-    if (ParseTree::children.size() > 0) {
-        // Output if the node has children
-        output += ParseTree::type + "\n";
-        for (ParseTree* child : children) {
-            output += indent + "  \u2514 " + child->tostring(depth + 1);
+    ParseTree* node = this;
+    while (true) {
+        if (node != NULL) {
+            if (node->children.size() > 0) {
+                // Output if the node has children
+                output += node->type + "\n";
+                stack.push_back(Pending{node, node->children.begin()});
+            } else {
+                // Output if the node is a leaf/terminal
+                output += node->type + " " + node->value + "\n";
+            }
+            node = NULL;
+        }
+
+        if (stack.empty()) {
+            break;
+        }
+
+        Pending& top = stack.back();
+        if (top.next != top.node->children.end()) {
+            // next child, indented one level below its parent
+            output += indent + "  \u2514 ";
+            node = *top.next;
+            ++top.next;
+            if (node->children.size() > 0) {
+                indent += unit;
+            }
+        } else {
+            // close the node at its own indentation, then step back out to its parent's
+            output += indent + "\n";
+            stack.pop_back();
+            if (!stack.empty()) {
+                indent.erase(indent.size() - unit.size());
+            }
         }
-        output += indent + "\n";
-    } else {
-        // Output if the node is a leaf/terminal
-        output += ParseTree::type + " " + ParseTree::value + "\n";
     }
     return output;
 }
\ No newline at end of file
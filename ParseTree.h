@@ -1,6 +1,7 @@
 #ifndef PARSETREE_H
 #define PARSETREE_H
 
+#include <cstddef>
 #include <string>
 #include <list>
 
@@ -13,13 +14,16 @@ class ParseTree {
     public:
         ParseTree(std::string type, std::string value);
 
+        static void* operator new(std::size_t size);
+        static void operator delete(void* memory, std::size_t size);
+
         void addChild(ParseTree* child);
 
-        std::list<ParseTree*> getChildren();
+        const std::list<ParseTree*>& getChildren();
 
-        std::string getType();
+        const std::string& getType();
 
-        std::string getValue();
+        const std::string& getValue();
 
         std::string tostring();
 
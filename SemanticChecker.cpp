@@ -0,0 +1,378 @@
+#include "SemanticChecker.h"
+#include "Trace.h"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+/**
+ * Constructor for the SemanticChecker
+ * @param classes A list of parse trees produced by CompilerParser::compileClass()
+ */
+SemanticChecker::SemanticChecker(std::list<ParseTree*> classes) {
+    this->classes = classes;
+}
+
+/**
+ * Check every class for undeclared variables and subroutine calls that do not match a declared signature.
+ * Signatures from every class are collected first into a read-only table, then each class is checked on its own thread.
+ * If any problems are found, throw a SemanticException. The problems can be read using getErrors().
+ */
+void SemanticChecker::check() {
+    // build the shared signature table before any worker starts
+    {
+        TraceSpan span("signatures", "semantic");
+        signatures.clear();
+        classNames.clear();
+        for (ParseTree* classTree : classes) {
+            addSignatures(classTree);
+        }
+    }
+
+    std::vector<ParseTree*> work(classes.begin(), classes.end());
+    std::vector<std::list<std::string>> results(work.size());
+    std::atomic<size_t> nextClass(0);
+
+    unsigned int workers = std::thread::hardware_concurrency();
+    if (workers == 0) {
+        workers = 1;
+    }
+    if (workers > work.size()) {
+        workers = work.size();
+    }
+
+    // each worker takes the next unchecked class until none are left
+    std::vector<std::thread> threads;
+    for (unsigned int i = 0; i < workers; i++) {
+        threads.push_back(std::thread([&]() {
+            for (size_t j = nextClass++; j < work.size(); j = nextClass++) {
+                results[j] = checkClass(work[j]);
+            }
+        }));
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+
+    // report in class order so the output does not depend on scheduling
+    errors.clear();
+    for (std::list<std::string>& found : results) {
+        errors.splice(errors.end(), found);
+    }
+
+    if (!errors.empty()) {
+        throw SemanticException();
+    }
+}
+
+/**
+ * Get the problems found by the last call to check()
+ * @return A list of messages, one per problem
+ */
+std::list<std::string> SemanticChecker::getErrors() {
+    return errors;
+}
+
+/**
+ * Add the signature of every subroutine in a class to the signature table
+ * @param classTree The class to read
+ */
+void SemanticChecker::addSignatures(ParseTree* classTree) {
+    const std::list<ParseTree*>& children = classTree->getChildren();
+    std::vector<ParseTree*> c(children.begin(), children.end());
+    if (c.size() < 2) {
+        return;
+    }
+
+    std::string className = c[1]->getValue();
+    classNames.insert(className);
+    addSignatures(className, classTree);
+}
+
+/**
+ * Add the signature of every subroutine under a node to the signature table,
+ * including subroutines parsed inside a term, which belong to the enclosing class.
+ * Walks an explicit worklist so that any tree the parser accepts can be searched.
+ * @param className The class the subroutines belong to
+ * @param root The node to search
+ */
+void SemanticChecker::addSignatures(std::string className, ParseTree* root) {
+    std::vector<ParseTree*> worklist;
+    worklist.push_back(root);
+
+    while (!worklist.empty()) {
+        ParseTree* node = worklist.back();
+        worklist.pop_back();
+
+        for (ParseTree* child : node->getChildren()) {
+            worklist.push_back(child);
+        }
+
+        if (node->getType() != "subroutine") {
+            continue;
+        }
+
+        const std::list<ParseTree*>& parts = node->getChildren();
+        std::vector<ParseTree*> p(parts.begin(), parts.end());
+        if (p.size() < 5) {
+            continue;
+        }
+
+        // parameters alternate type, name, then ',' before the next pair
+        int argCount = 0;
+        bool expectType = true;
+        for (ParseTree* param : p[4]->getChildren()) {
+            if (param->getValue() == ",") {
+                expectType = true;
+            }
+            else if (expectType) {
+                expectType = false;
+            }
+            else {
+                argCount++;
+            }
+        }
+
+        Signature signature;
+        signature.kind = p[0]->getValue();
+        signature.argCount = argCount;
+        signatures[className + "." + p[2]->getValue()] = signature;
+    }
+}
+
+/**
+ * Check every subroutine in a class
+ * @param classTree The class to check
+ * @return A list of problems found in this class
+ */
+std::list<std::string> SemanticChecker::checkClass(ParseTree* classTree) {
+    std::list<std::string> found;
+
+    const std::list<ParseTree*>& children = classTree->getChildren();
+    std::vector<ParseTree*> c(children.begin(), children.end());
+    if (c.size() < 2) {
+        return found;
+    }
+
+    Scope scope;
+    scope.className = c[1]->getValue();
+
+    TraceSpan span(scope.className, "semantic");
+
+    // static and field variables are visible to every subroutine
+    for (ParseTree* child : c) {
+        if (child->getType() != "classVarDec") {
+            continue;
+        }
+        const std::list<ParseTree*>& parts = child->getChildren();
+        std::vector<ParseTree*> p(parts.begin(), parts.end());
+        for (size_t i = 2; i < p.size(); i++) {
+            if (p[i]->getType() == "identifier") {
+                scope.classVariables[p[i]->getValue()] = p[1]->getValue();
+            }
+        }
+    }
+
+    for (ParseTree* child : c) {
+        if (child->getType() == "subroutine") {
+            checkSubroutine(child, scope, found);
+        }
+    }
+
+    return found;
+}
+
+/**
+ * Check a single subroutine
+ * @param subroutine The subroutine to check
+ * @param scope The enclosing scope. Only its class variables are kept; parameters and local variables are added here
+ * @param found The list to add problems to
+ */
+void SemanticChecker::checkSubroutine(ParseTree* subroutine, Scope scope, std::list<std::string>& found) {
+    const std::list<ParseTree*>& parts = subroutine->getChildren();
+    std::vector<ParseTree*> p(parts.begin(), parts.end());
+    if (p.size() < 7) {
+        return;
+    }
+
+    scope.subroutineKind = p[0]->getValue();
+    scope.subroutineName = p[2]->getValue();
+    scope.variables = scope.classVariables;
+
+    // add parameters
+    std::string type = "";
+    bool expectType = true;
+    for (ParseTree* param : p[4]->getChildren()) {
+        if (param->getValue() == ",") {
+            expectType = true;
+        }
+        else if (expectType) {
+            type = param->getValue();
+            expectType = false;
+        }
+        else {
+            scope.variables[param->getValue()] = type;
+        }
+    }
+
+    // add local variables
+    for (ParseTree* child : p[6]->getChildren()) {
+        if (child->getType() != "varDec") {
+            continue;
+        }
+        const std::list<ParseTree*>& decParts = child->getChildren();
+        std::vector<ParseTree*> d(decParts.begin(), decParts.end());
+        for (size_t i = 2; i < d.size(); i++) {
+            if (d[i]->getType() == "identifier") {
+                scope.variables[d[i]->getValue()] = d[1]->getValue();
+            }
+        }
+    }
+
+    // check statements
+    for (ParseTree* child : p[6]->getChildren()) {
+        if (child->getType() == "statements") {
+            checkNode(child, scope, found);
+        }
+    }
+}
+
+/**
+ * Check a statement or expression node and everything below it.
+ * Nodes are visited in order from an explicit worklist, so statement and expression nesting does not grow the call stack;
+ * only subroutines parsed inside a term recurse, and the parser's depth limit bounds those.
+ * @param root The node to check
+ * @param scope The variables visible to this node
+ * @param found The list to add problems to
+ */
+void SemanticChecker::checkNode(ParseTree* root, Scope& scope, std::list<std::string>& found) {
+    std::vector<ParseTree*> worklist;
+    worklist.push_back(root);
+
+    while (!worklist.empty()) {
+        ParseTree* node = worklist.back();
+        worklist.pop_back();
+
+        const std::string& type = node->getType();
+        const std::list<ParseTree*>& children = node->getChildren();
+
+        // a subroutine parsed inside a term sees its class's variables, not the enclosing subroutine's
+        if (type == "subroutine") {
+            checkSubroutine(node, scope, found);
+            continue;
+        }
+
+        if (type == "term") {
+            checkTerm(node, scope, found);
+        }
+        else if (type == "letStatement" && children.size() > 1) {
+            std::string name = (*std::next(children.begin()))->getValue();
+            if (scope.variables.count(name) == 0) {
+                found.push_back(scope.className + "." + scope.subroutineName + ": undeclared variable '" + name + "'");
+            }
+        }
+
+        // push in reverse so children are visited first to last
+        for (std::list<ParseTree*>::const_reverse_iterator child = children.rbegin(); child != children.rend(); ++child) {
+            worklist.push_back(*child);
+        }
+    }
+}
+
+/**
+ * Check a term for undeclared variables and mismatched subroutine calls.
+ * The term's children are checked by checkNode().
+ * @param term The term to check
+ * @param scope The variables visible to this term
+ * @param found The list to add problems to
+ */
+void SemanticChecker::checkTerm(ParseTree* term, Scope& scope, std::list<std::string>& found) {
+    const std::list<ParseTree*>& children = term->getChildren();
+    std::vector<ParseTree*> c(children.begin(), children.end());
+
+    if (!c.empty() && c[0]->getType() == "identifier") {
+        std::string name = c[0]->getValue();
+
+        if (c.size() >= 4 && c[1]->getValue() == "(") {
+            // subroutineName(expressionList) in this class
+            checkCall(scope.className, name, "this", c[2], scope, found);
+        }
+        else if (c.size() >= 6 && c[1]->getValue() == ".") {
+            // varName.subroutineName(...) calls into the variable's type, otherwise className.subroutineName(...)
+            if (scope.variables.count(name) > 0) {
+                checkCall(scope.variables[name], c[2]->getValue(), "instance", c[4], scope, found);
+            }
+            else {
+                checkCall(name, c[2]->getValue(), "class", c[4], scope, found);
+            }
+        }
+        else if (scope.variables.count(name) == 0) {
+            // varName or varName[expression]
+            found.push_back(scope.className + "." + scope.subroutineName + ": undeclared variable '" + name + "'");
+        }
+    }
+}
+
+/**
+ * Check a subroutine call against the signature table.
+ * Calls into classes that were not given to the checker (such as the OS) are not checked.
+ * @param className The class the called subroutine belongs to
+ * @param subroutineName The called subroutine
+ * @param via How the call was made: "this" for subroutineName(...), "class" for className.subroutineName(...), "instance" for varName.subroutineName(...)
+ * @param expressionList The arguments of the call
+ * @param scope The scope making the call
+ * @param found The list to add problems to
+ */
+void SemanticChecker::checkCall(std::string className, std::string subroutineName, std::string via, ParseTree* expressionList, Scope& scope, std::list<std::string>& found) {
+    if (classNames.count(className) == 0) {
+        return;
+    }
+
+    std::string where = scope.className + "." + scope.subroutineName + ": ";
+    std::map<std::string, Signature>::const_iterator signature = signatures.find(className + "." + subroutineName);
+    if (signature == signatures.end()) {
+        found.push_back(where + "call to undeclared subroutine '" + className + "." + subroutineName + "'");
+        return;
+    }
+
+    // methods need an object; functions and constructors must not be given one
+    std::string name = "'" + className + "." + subroutineName + "'";
+    const std::string& kind = signature->second.kind;
+    if (via == "class" && kind == "method") {
+        found.push_back(where + "method " + name + " is called through its class instead of an object");
+    }
+    else if (via == "instance" && kind != "method") {
+        found.push_back(where + kind + " " + name + " is called through an object instead of its class");
+    }
+    else if (via == "this" && kind == "method" && scope.subroutineKind == "function") {
+        found.push_back(where + "method " + name + " is called from a function without an object");
+    }
+
+    int argCount = countArguments(expressionList);
+    if (argCount != signature->second.argCount) {
+        found.push_back(where + "'" + className + "." + subroutineName + "' expects " + std::to_string(signature->second.argCount) + " argument(s) but was given " + std::to_string(argCount));
+    }
+}
+
+/**
+ * Count the arguments in an expression list. An empty call still produces one empty expression.
+ * @param expressionList The expression list to count
+ * @return The number of non-empty expressions
+ */
+int SemanticChecker::countArguments(ParseTree* expressionList) {
+    int count = 0;
+    for (ParseTree* child : expressionList->getChildren()) {
+        if (child->getType() == "expression" && !child->getChildren().empty()) {
+            count++;
+        }
+    }
+    return count;
+}
+
+/**
+ * Definition of a SemanticException
+ * You can use this SemanticException with `throw SemanticException();`
+ */
+const char* SemanticException::what() {
+    return "An Exception occurred while checking semantics!";
+}
@@ -0,0 +1,53 @@
+#ifndef SEMANTICCHECKER_H
+#define SEMANTICCHECKER_H
+
+#include <list>
+#include <map>
+#include <set>
+#include <string>
+#include <exception>
+
+#include "ParseTree.h"
+
+class SemanticChecker {
+    public:
+        SemanticChecker(std::list<ParseTree*> classes);
+
+        void check();
+        std::list<std::string> getErrors();
+
+    private:
+        struct Signature {
+            std::string kind;
+            int argCount;
+        };
+
+        struct Scope {
+            std::string className;
+            std::string subroutineName;
+            std::string subroutineKind;
+            std::map<std::string, std::string> classVariables;
+            std::map<std::string, std::string> variables;
+        };
+
+        std::list<ParseTree*> classes;
+        std::map<std::string, Signature> signatures;
+        std::set<std::string> classNames;
+        std::list<std::string> errors;
+
+        void addSignatures(ParseTree* classTree);
+        void addSignatures(std::string className, ParseTree* root);
+        std::list<std::string> checkClass(ParseTree* classTree);
+        void checkSubroutine(ParseTree* subroutine, Scope scope, std::list<std::string>& found);
+        void checkNode(ParseTree* root, Scope& scope, std::list<std::string>& found);
+        void checkTerm(ParseTree* term, Scope& scope, std::list<std::string>& found);
+        void checkCall(std::string className, std::string subroutineName, std::string via, ParseTree* expressionList, Scope& scope, std::list<std::string>& found);
+        int countArguments(ParseTree* expressionList);
+};
+
+class SemanticException : public std::exception {
+    public:
+        const char* what();
+};
+
+#endif /*SEMANTICCHECKER_H*/
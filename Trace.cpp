@@ -0,0 +1,133 @@
+#include "Trace.h"
+#include "Json.h"
+
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <list>
+#include <mutex>
+#include <vector>
+
+namespace {
+    struct Event {
+        std::string name;
+        std::string category;
+        long long start;
+        long long duration;
+    };
+
+    struct Buffer {
+        int thread;
+        std::vector<Event> events;
+    };
+
+    std::atomic<bool> tracing(false);
+    std::mutex buffersLock;
+    std::list<Buffer*> buffers;
+    thread_local Buffer* buffer = nullptr;
+}
+
+/**
+ * Start recording spans. Until this is called every TraceSpan is a no-op.
+ */
+void Trace::enable() {
+    tracing = true;
+}
+
+/**
+ * Check if spans are being recorded
+ * @return true if tracing is enabled, false otherwise
+ */
+bool Trace::enabled() {
+    return tracing;
+}
+
+/**
+ * Record a finished span in the calling thread's buffer.
+ * The lock is only taken the first time a thread records, to register its buffer.
+ * @param name The span's name
+ * @param category The span's category, such as the pipeline phase
+ * @param start Start time in microseconds, from Trace::now()
+ * @param duration Duration in microseconds
+ */
+void Trace::record(const std::string& name, const std::string& category, long long start, long long duration) {
+    if (buffer == nullptr) {
+        std::lock_guard<std::mutex> guard(buffersLock);
+        buffer = new Buffer();
+        buffer->thread = buffers.size() + 1;
+        buffers.push_back(buffer);
+    }
+
+    Event event;
+    event.name = name;
+    event.category = category;
+    event.start = start;
+    event.duration = duration;
+    buffer->events.push_back(event);
+}
+
+/**
+ * Get the current time for a span
+ * @return Microseconds on a steady clock
+ */
+long long Trace::now() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/**
+ * Write every recorded span as a Chrome trace-event JSON file, one lane per thread.
+ * Open the file in chrome://tracing or ui.perfetto.dev. Call once the traced work has finished.
+ * @param filename The file to write
+ */
+void Trace::write(const std::string& filename) {
+    std::lock_guard<std::mutex> guard(buffersLock);
+
+    std::ofstream out(filename);
+    out << "{\"traceEvents\":[";
+    bool first = true;
+    for (Buffer* b : buffers) {
+        for (const Event& event : b->events) {
+            if (!first) {
+                out << ",";
+            }
+            first = false;
+            out << "\n{\"name\":\"" << jsonEscape(event.name) << "\",\"cat\":\"" << jsonEscape(event.category)
+                << "\",\"ph\":\"X\",\"ts\":" << event.start << ",\"dur\":" << event.duration
+                << ",\"pid\":1,\"tid\":" << b->thread << "}";
+        }
+    }
+    out << "\n]}\n";
+}
+
+/**
+ * Time the enclosing scope as one span on the current thread's lane
+ * @param name The span's name
+ * @param category The span's category, such as the pipeline phase
+ */
+TraceSpan::TraceSpan(const std::string& name, const std::string& category) {
+    active = Trace::enabled();
+    if (active) {
+        this->name = name;
+        this->category = category;
+        start = Trace::now();
+    }
+}
+
+/**
+ * Rename the span, for when its subject is only known part way through the scope
+ * @param name The span's new name
+ */
+void TraceSpan::setName(const std::string& name) {
+    if (active) {
+        this->name = name;
+    }
+}
+
+/**
+ * Record the span when the enclosing scope ends
+ */
+TraceSpan::~TraceSpan() {
+    if (active) {
+        Trace::record(name, category, start, Trace::now() - start);
+    }
+}
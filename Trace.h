@@ -0,0 +1,29 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <string>
+
+class Trace {
+    public:
+        static void enable();
+        static bool enabled();
+        static void record(const std::string& name, const std::string& category, long long start, long long duration);
+        static long long now();
+        static void write(const std::string& filename);
+};
+
+class TraceSpan {
+    public:
+        TraceSpan(const std::string& name, const std::string& category);
+        ~TraceSpan();
+
+        void setName(const std::string& name);
+
+    private:
+        std::string name;
+        std::string category;
+        long long start;
+        bool active;
+};
+
+#endif /*TRACE_H*/